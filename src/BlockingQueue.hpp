@@ -3,6 +3,8 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
+#include <algorithm>
 
 template<typename Data>
 class BlockingQueue {
@@ -85,6 +87,73 @@ public:
         return true;
     }
 
+    // Moves all items into the queue, taking the lock and waking consumers once per chunk that fits
+    void push_bulk(std::vector<Data>& items)
+    {
+        if (items.empty()) {
+            return;
+        }
+        std::unique_lock lock(queue_mutex);
+        size_t pushed = 0;
+        while (pushed < items.size()) {
+            size_t to_push = items.size() - pushed;
+            if (queue_limit > 0) {
+                while (queue.size() >= queue_limit) {
+                    is_overflown = true;
+                    item_removed_event.wait(lock);
+                }
+                to_push = std::min(to_push, queue_limit - queue.size());
+            }
+            for (size_t i = 0; i < to_push; i++) {
+                queue.push(std::move(items[pushed++]));
+            }
+            if (is_empty) {
+                if (queue.size() >= (1.0 - watermark) * queue_limit) {
+                    is_empty = false;
+                    new_item_or_closed_event.notify_all();
+                }
+            }
+            else {
+                new_item_or_closed_event.notify_one();
+            }
+        }
+        items.clear();
+    }
+
+    // Pops up to max_items items into popped_values (which is cleared first)
+    // Returns false only if the queue is closed and no items are left
+    bool pop_bulk(std::vector<Data>& popped_values, size_t max_items)
+    {
+        popped_values.clear();
+        std::unique_lock lock(queue_mutex);
+        while (queue.empty()) {
+            if (is_closed) {
+                return false;
+            }
+            is_empty = true;
+            new_item_or_closed_event.wait(lock);
+        }
+        size_t to_pop = std::min(std::max<size_t>(max_items, 1), queue.size());
+        for (size_t i = 0; i < to_pop; i++) {
+            popped_values.push_back(std::move(queue.front()));
+            queue.pop();
+        }
+        // Producer woke a single consumer for the whole chunk, pass the rest on to the next one
+        if (!queue.empty()) {
+            new_item_or_closed_event.notify_one();
+        }
+        if (is_overflown) {
+            if (queue.size() <= watermark * queue_limit) {
+                is_overflown = false;
+                item_removed_event.notify_all();
+            }
+        }
+        else {
+            item_removed_event.notify_one();
+        }
+        return true;
+    }
+
     const size_t get_size() const
     {
         return queue.size();
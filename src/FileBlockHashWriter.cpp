@@ -2,10 +2,14 @@
 #include <filesystem>
 #include <boost/log/trivial.hpp>
 
-FileBlockHashWriter::FileBlockHashWriter(const std::shared_ptr<BlockingQueue<BlockHash>>& input_queue, const std::string& file_name, const size_t seek_reduction_factor)
-	: input_queue(input_queue), output_file(file_name), io_buffer(io_buffer_size_bytes), seek_reduction_factor(seek_reduction_factor)
+FileBlockHashWriter::FileBlockHashWriter(const std::shared_ptr<BlockingQueue<BlockHash>>& input_queue, const std::string& file_name, const size_t seek_reduction_factor, const size_t batch_size)
+	: input_queue(input_queue), output_file(file_name), io_buffer(io_buffer_size_bytes), seek_reduction_factor(seek_reduction_factor), batch_size(batch_size)
 {
+	block_hashes.reserve(batch_size);
 	std::ios::sync_with_stdio(false);
+	if (seek_reduction_factor == 0) {
+		throw std::runtime_error("Seek reduction factor must be positive");
+	}
 	if (std::filesystem::exists(output_file)) {
 		throw std::runtime_error("Output file " + output_file + " already exists");
 	}
@@ -38,12 +42,19 @@ void FileBlockHashWriter::write_last_buffer()
 
 bool FileBlockHashWriter::do_work()
 {
-	bool block_read = input_queue->pop(block_hash);
-	if (!block_read) {
+	bool hashes_read = input_queue->pop_bulk(block_hashes, batch_size);
+	if (!hashes_read) {
 		write_last_buffer();
 		return false;
 	}
+	for (const BlockHash& block_hash : block_hashes) {
+		add_hash(block_hash);
+	}
+	return true;
+}
 
+void FileBlockHashWriter::add_hash(const BlockHash& block_hash)
+{
 	// Writing hashes to file seems to be a choke point in many cases
 	// Minimize file seeks by preparing a big buffer to write first
 	size_t buffer_index = block_hash.position / seek_reduction_factor;
@@ -58,7 +69,6 @@ bool FileBlockHashWriter::do_work()
 		file.write(buffer.get_data(), buffer.get_size());
 		hash_buffers.erase(it.first);
 	}
-	return true;
 }
 
 void FileBlockHashWriter::on_stop()
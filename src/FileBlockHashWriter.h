@@ -18,13 +18,15 @@ class FileBlockHashWriter : public Worker
 	std::shared_ptr<BlockingQueue<BlockHash>> input_queue;
 	std::ofstream file;
 	std::vector<char> io_buffer;
-	BlockHash block_hash;
+	const size_t batch_size;
+	std::vector<BlockHash> block_hashes;
 	std::map<size_t, FileBlockHashBuffer> hash_buffers;
 
 	void write_last_buffer();
+	void add_hash(const BlockHash& block_hash);
 
 public:
-	FileBlockHashWriter(const std::shared_ptr<BlockingQueue<BlockHash>>& input_queue, const std::string& file_name, const size_t seek_reduction_factor);
+	FileBlockHashWriter(const std::shared_ptr<BlockingQueue<BlockHash>>& input_queue, const std::string& file_name, const size_t seek_reduction_factor, const size_t batch_size = 1);
 	void on_start() override;
 	bool do_work() override;
 	void on_stop() override;
@@ -7,20 +7,34 @@
 using boost::uuids::detail::md5;
 
 FileBlockHasherMD5::FileBlockHasherMD5(const std::shared_ptr<BlockingQueue<FileBlock>>& input_queue,
-	const std::shared_ptr<BlockingQueue<BlockHash>>& output_queue)
-	: input_queue(input_queue), output_queue(output_queue)
+	const std::shared_ptr<BlockingQueue<BlockHash>>& output_queue, const size_t batch_size)
+	: FileBlockHasherMD5(input_queue, std::vector<std::shared_ptr<BlockingQueue<BlockHash>>>{ output_queue }, std::vector<size_t>{ 0 }, batch_size)
+{}
+
+FileBlockHasherMD5::FileBlockHasherMD5(const std::shared_ptr<BlockingQueue<FileBlock>>& input_queue,
+	const std::vector<std::shared_ptr<BlockingQueue<BlockHash>>>& output_queues,
+	const std::vector<size_t>& block_sizes, const size_t batch_size,
+	const std::shared_ptr<ResourceGovernor>& governor)
+	: input_queue(input_queue), output_queues(output_queues), block_sizes(block_sizes), batch_size(batch_size), output_hashes(output_queues.size()),
+	  governor(governor)
 {
-	output_queue->start_writing();
+	if (output_queues.size() != block_sizes.size()) {
+		throw std::runtime_error("Number of output queues does not match number of block sizes");
+	}
+	input_blocks.reserve(batch_size);
+	for (auto& output_queue : output_queues) {
+		output_queue->start_writing();
+	}
 }
 
-std::string FileBlockHasherMD5::md5_hash(const FileBlock& block)
+std::string FileBlockHasherMD5::md5_hash(const char* data, size_t size)
 {
 	md5 hash;
 	md5::digest_type digest;
 	const char* char_digest;
 	std::string result;
 
-	hash.process_bytes(block.data.get(), block.size);
+	hash.process_bytes(data, size);
 	hash.get_digest(digest);
 	char_digest = reinterpret_cast<const char*>(&digest);
 	boost::algorithm::hex(char_digest, char_digest + sizeof(md5::digest_type), std::back_inserter(result));
@@ -34,27 +48,46 @@ void FileBlockHasherMD5::on_start()
 
 bool FileBlockHasherMD5::do_work()
 {
-	bool block_read = input_queue->pop(input_block);
-	if (!block_read) {
+	bool blocks_read = input_queue->pop_bulk(input_blocks, batch_size);
+	if (!blocks_read) {
 		return false;
 	}
-	BlockHash block_hash(input_block.position, md5_hash(input_block));
-	output_queue->push(std::move(block_hash));
+	HasherSlot slot(governor.get());
+	for (size_t i = 0; i < output_queues.size(); i++) {
+		for (const FileBlock& input_block : input_blocks) {
+			if (block_sizes[i] == 0) {
+				output_hashes[i].emplace_back(input_block.position, md5_hash(input_block.data.get(), input_block.size));
+				continue;
+			}
+			size_t sub_blocks_per_block = input_block.size / block_sizes[i];
+			size_t sub_blocks = (input_block.data_size + block_sizes[i] - 1) / block_sizes[i];
+			for (size_t j = 0; j < sub_blocks; j++) {
+				output_hashes[i].emplace_back(input_block.position * sub_blocks_per_block + j,
+					md5_hash(input_block.data.get() + j * block_sizes[i], block_sizes[i]));
+			}
+		}
+		output_queues[i]->push_bulk(output_hashes[i]);
+	}
+	input_blocks.clear();
 	return true;
 }
 
+void FileBlockHasherMD5::stop_writing()
+{
+	for (auto& output_queue : output_queues) {
+		output_queue->stop_writing();
+	}
+	output_queues.clear();
+}
+
 void FileBlockHasherMD5::on_stop()
 {
 	BOOST_LOG_TRIVIAL(debug) << "Stopping FileBlockHasherMD5";
-	output_queue->stop_writing();
-	output_queue.reset();
+	stop_writing();
 	BOOST_LOG_TRIVIAL(debug) << "Stopped FileBlockHasherMD5";
 }
 
 FileBlockHasherMD5::~FileBlockHasherMD5()
 {
-	if (output_queue) {
-		output_queue->stop_writing();
-		output_queue.reset();
-	}
-}
\ No newline at end of file
+	stop_writing();
+}
@@ -2,20 +2,37 @@
 #include "data/BlockHash.h"
 #include "BlockingQueue.hpp"
 #include "Worker.h"
+#include "ResourceGovernor.h"
+#include <vector>
 
 /*
-	Calculates MD5 hashes for file blocks from input_queue and writes them into output_queue
+	Calculates MD5 hashes for file blocks from input_queue and writes them into output_queue,
+	up to batch_size blocks per queue operation.
+	With several output queues, every file block is split into sub-blocks of the matching size
+	(which must divide the file block size) and each resolution is hashed into its own queue,
+	so the file is read only once. Sub-blocks past the end of the data are skipped.
+	With governor, hashing of every batch waits for a free hasher slot
 */
 class FileBlockHasherMD5 : public Worker
 {
 	std::shared_ptr<BlockingQueue<FileBlock>> input_queue;
-	std::shared_ptr<BlockingQueue<BlockHash>> output_queue;
-	FileBlock input_block;
-	static std::string md5_hash(const FileBlock& block);
+	std::vector<std::shared_ptr<BlockingQueue<BlockHash>>> output_queues;
+	// 0 means the whole file block
+	const std::vector<size_t> block_sizes;
+	const size_t batch_size;
+	std::vector<FileBlock> input_blocks;
+	std::vector<std::vector<BlockHash>> output_hashes;
+	std::shared_ptr<ResourceGovernor> governor;
+	void stop_writing();
 
 public:
+	static std::string md5_hash(const char* data, size_t size);
 	FileBlockHasherMD5(const std::shared_ptr<BlockingQueue<FileBlock>>& input_queue,
-		const std::shared_ptr<BlockingQueue<BlockHash>>& output_queue);
+		const std::shared_ptr<BlockingQueue<BlockHash>>& output_queue, const size_t batch_size = 1);
+	FileBlockHasherMD5(const std::shared_ptr<BlockingQueue<FileBlock>>& input_queue,
+		const std::vector<std::shared_ptr<BlockingQueue<BlockHash>>>& output_queues,
+		const std::vector<size_t>& block_sizes, const size_t batch_size = 1,
+		const std::shared_ptr<ResourceGovernor>& governor = nullptr);
 	void on_start() override;
 	bool do_work() override;
 	void on_stop() override;
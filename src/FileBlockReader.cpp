@@ -1,9 +1,19 @@
 #include "FileBlockReader.h"
 #include <boost/log/trivial.hpp>
+#include <algorithm>
 
-FileBlockReader::FileBlockReader(const std::shared_ptr<BlockingQueue<FileBlock>>& output_queue, const std::string& file_name, const size_t block_size)
-	: output_queue(output_queue), block_size(block_size), input_file(file_name), io_buffer(io_buffer_size_bytes)
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+FileBlockReader::FileBlockReader(const std::shared_ptr<BlockingQueue<FileBlock>>& output_queue, const std::string& file_name, const size_t block_size, const size_t batch_size,
+	const std::shared_ptr<ResourceGovernor>& governor)
+	: output_queue(output_queue), block_size(block_size), batch_size(batch_size), input_file(file_name), io_buffer(io_buffer_size_bytes), governor(governor)
 {
+	output_blocks.reserve(batch_size);
 	std::ios::sync_with_stdio(false);
 	output_queue->start_writing();
 	file.open(input_file, std::ios::binary);
@@ -12,6 +22,78 @@ FileBlockReader::FileBlockReader(const std::shared_ptr<BlockingQueue<FileBlock>>
 		throw std::runtime_error("Error opening input file " + input_file);
 	}
 	file.rdbuf()->pubsetbuf(io_buffer.data(), io_buffer_size_bytes);
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+	// Page cache is shared by all descriptors of the file, a separate one is enough to give advice
+	if (governor) {
+		page_cache_fd = open(input_file.c_str(), O_RDONLY);
+		if (page_cache_fd >= 0 && !find_cached_pages()) {
+			BOOST_LOG_TRIVIAL(warning) << "Cannot determine cached pages of " << input_file << ", page cache will not be dropped";
+			close(page_cache_fd);
+			page_cache_fd = -1;
+		}
+	}
+#endif
+}
+
+bool FileBlockReader::find_cached_pages()
+{
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+	struct stat file_stat;
+	if (fstat(page_cache_fd, &file_stat) != 0) {
+		return false;
+	}
+	page_size = sysconf(_SC_PAGESIZE);
+	uint64_t file_size = file_stat.st_size;
+	initially_cached_pages.assign((file_size + page_size - 1) / page_size, false);
+	// Map the file window by window, mincore reports residency without reading anything
+	std::vector<unsigned char> residency;
+	for (uint64_t offset = 0; offset < file_size; offset += residency_check_window_bytes) {
+		size_t window_size = std::min<uint64_t>(residency_check_window_bytes, file_size - offset);
+		void* window = mmap(nullptr, window_size, PROT_READ, MAP_SHARED, page_cache_fd, offset);
+		if (window == MAP_FAILED) {
+			return false;
+		}
+		residency.resize((window_size + page_size - 1) / page_size);
+		bool result = mincore(window, window_size, residency.data()) == 0;
+		munmap(window, window_size);
+		if (!result) {
+			return false;
+		}
+		size_t first_page = offset / page_size;
+		for (size_t i = 0; i < residency.size(); i++) {
+			initially_cached_pages[first_page + i] = residency[i] & 1;
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FileBlockReader::drop_page_cache(uint64_t bytes_read, bool is_last)
+{
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+	if (page_cache_fd < 0) {
+		return;
+	}
+	// Partially read page is kept until the end, the rest of it is read with the next batch.
+	// Advice is ignored for pages the kernel has not finished adding to page cache yet,
+	// so the last call goes over the whole file once more
+	size_t pages_read = std::min<uint64_t>(is_last ? (bytes_read + page_size - 1) / page_size : bytes_read / page_size, initially_cached_pages.size());
+	size_t page = is_last ? 0 : page_cache_dropped_pages;
+	while (page < pages_read) {
+		if (initially_cached_pages[page]) {
+			page++;
+			continue;
+		}
+		size_t first_page = page;
+		while (page < pages_read && !initially_cached_pages[page]) {
+			page++;
+		}
+		posix_fadvise(page_cache_fd, static_cast<off_t>(first_page) * page_size, static_cast<off_t>(page - first_page) * page_size, POSIX_FADV_DONTNEED);
+	}
+	page_cache_dropped_pages = std::max(page_cache_dropped_pages, pages_read);
+#endif
 }
 
 void FileBlockReader::on_start()
@@ -21,23 +103,37 @@ void FileBlockReader::on_start()
 
 bool FileBlockReader::do_work()
 {
-	FileBlock block(current_pos++, block_size);
-	file.read(block.data.get(), block_size);
-	size_t bytes_read = file.gcount();
-	if (bytes_read == 0) {
-		return false;
+	bool has_more_data = true;
+	size_t batch_bytes = 0;
+	while (has_more_data && output_blocks.size() < batch_size) {
+		FileBlock block(current_pos++, block_size);
+		file.read(block.data.get(), block_size);
+		size_t bytes_read = file.gcount();
+		if (bytes_read == 0) {
+			has_more_data = false;
+			break;
+		}
+		if (bytes_read < block_size) {
+			std::fill_n(block.data.get() + bytes_read, block_size - bytes_read, 0);
+			block.data_size = bytes_read;
+		}
+		batch_bytes += bytes_read;
+		output_blocks.push_back(std::move(block));
+		has_more_data = !file.eof();
 	}
-	if (bytes_read < block_size) {
-		std::fill_n(block.data.get() + bytes_read, block_size - bytes_read, 0);
+	output_queue->push_bulk(output_blocks);
+	if (governor) {
+		drop_page_cache(static_cast<uint64_t>(current_pos) * block_size, false);
+		governor->acquire_read(batch_bytes);
 	}
-	output_queue->push(std::move(block));
-	return !file.eof();
+	return has_more_data;
 }
 
 void FileBlockReader::on_stop()
 {
 	BOOST_LOG_TRIVIAL(debug) << "Stopping FileBlockReader";
 	file.close();
+	drop_page_cache(static_cast<uint64_t>(current_pos) * block_size, true);
 	output_queue->stop_writing();
 	output_queue.reset();
 	BOOST_LOG_TRIVIAL(debug) << "Stopped FileBlockReader";
@@ -45,6 +141,11 @@ void FileBlockReader::on_stop()
 
 FileBlockReader::~FileBlockReader()
 {
+#ifndef _WIN32
+	if (page_cache_fd >= 0) {
+		close(page_cache_fd);
+	}
+#endif
 	if (output_queue) {
 		output_queue->stop_writing();
 		output_queue.reset();
@@ -2,25 +2,41 @@
 #include "Worker.h"
 #include "data/FileBlock.h"
 #include "BlockingQueue.hpp"
+#include "ResourceGovernor.h"
 #include <string>
 #include <fstream>
 #include <vector>
+#include <cstdint>
 
 /*
-	Reads input_file and puts its blocks into output_queue
+	Reads input_file and puts its blocks into output_queue, batch_size blocks at a time
+	With governor, reads are throttled and pages already read are dropped from page cache,
+	except pages that were cached before the reader started (other processes may be using them)
 */
 class FileBlockReader : public Worker
 {
 	static constexpr const size_t io_buffer_size_bytes = 1024 * 1024;
 	size_t current_pos = 0;
 	const size_t block_size;
+	const size_t batch_size;
 	const std::string input_file;
 	std::shared_ptr<BlockingQueue<FileBlock>> output_queue;
 	std::ifstream file;
 	std::vector<char> io_buffer;
+	std::vector<FileBlock> output_blocks;
+	std::shared_ptr<ResourceGovernor> governor;
+	static constexpr const size_t residency_check_window_bytes = 1024 * 1024 * 1024;
+	int page_cache_fd = -1;
+	size_t page_size = 0;
+	size_t page_cache_dropped_pages = 0;
+	std::vector<bool> initially_cached_pages;
+
+	bool find_cached_pages();
+	void drop_page_cache(uint64_t bytes_read, bool is_last);
 
 public:
-	FileBlockReader(const std::shared_ptr<BlockingQueue<FileBlock>>& output_queue, const std::string& file_name, const size_t block_size);
+	FileBlockReader(const std::shared_ptr<BlockingQueue<FileBlock>>& output_queue, const std::string& file_name, const size_t block_size, const size_t batch_size = 1,
+		const std::shared_ptr<ResourceGovernor>& governor = nullptr);
 	void on_start() override;
 	bool do_work() override;
 	void on_stop() override;
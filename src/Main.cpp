@@ -2,6 +2,8 @@
 #include "FileBlockReader.h"
 #include "FileBlockHasherMD5.h"
 #include "FileBlockHashWriter.h"
+#include "ResourceGovernor.h"
+#include "SignatureCache.h"
 #include "Task.h"
 
 #include <boost/log/utility/setup.hpp>
@@ -10,6 +12,9 @@
 #include <filesystem>
 #include <algorithm>
 #include <thread>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
 
 class SignatureApp
 {
@@ -17,7 +22,9 @@ class SignatureApp
     static constexpr const size_t max_file_data_memory_consumption_bytes = 100 * 1024 * 1024;
     static constexpr const size_t max_hash_data_memory_consumption_bytes = 100 * 1024 * 1024;
     static constexpr const size_t max_write_data_memory_consumption_bytes = 128 * 1024;
+    static constexpr const size_t max_batch_data_memory_consumption_bytes = 100 * 1024 * 1024;
     static constexpr const size_t max_queue_elements_per_thread = 1024;
+    static constexpr const size_t min_write_grouping = 1;
     static constexpr const size_t max_write_grouping = 128;
 
     // Other restrictions and constants
@@ -26,17 +33,29 @@ class SignatureApp
     static constexpr const size_t min_block_size_bytes = 512;
     static constexpr const size_t max_block_size_bytes = 10 * 1024 * 1024;
     static constexpr const size_t default_block_size_bytes = 1024 * 1024;
+    static constexpr const size_t max_resolutions = 8;
+    static constexpr const size_t min_batch_size = 1;
+    static constexpr const size_t max_batch_size = 4096;
+    static constexpr const size_t default_batch_size = 64;
+    static constexpr const uint64_t default_cache_size_bytes = 1024ULL * 1024ULL * 1024ULL;
+    static constexpr const char* hash_algorithm = "MD5";
 
     // Working variables
     std::string input_file;
     std::string output_file;
-    size_t block_size;
+    std::vector<size_t> block_sizes;
+    std::vector<std::string> output_files;
+    size_t read_block_size = 0;
+    size_t batch_size;
     size_t hasher_number;
     size_t max_block_number;
     size_t max_hash_number;
     size_t write_grouping;
     std::shared_ptr<BlockingQueue<FileBlock>> file_block_queue;
-    std::shared_ptr<BlockingQueue<BlockHash>> block_hash_queue;
+    std::vector<std::shared_ptr<BlockingQueue<BlockHash>>> block_hash_queues;
+    std::unique_ptr<SignatureCache> cache;
+    std::vector<std::string> cache_keys;
+    std::shared_ptr<ResourceGovernor> governor;
 
     void init_logging()
     {
@@ -56,24 +75,47 @@ class SignatureApp
 #endif
     }
 
-    void process_args(int argc, char* argv[])
+    bool process_args(int argc, char* argv[])
     {
-        if (argc < 3 || argc > 4) {
-            BOOST_LOG_TRIVIAL(info) << "Usage: " << argv[0] << " input_file output_file [block_size_bytes]";
-            return;
+        if (argc < 3 || argc > 5) {
+            BOOST_LOG_TRIVIAL(info) << "Usage: " << argv[0] << " input_file output_file [block_size_bytes[,block_size_bytes...]] [batch_size]";
+            return false;
         }
         input_file = argv[1];
         output_file = argv[2];
-        block_size = default_block_size_bytes;
-        if (argc == 4) {
+        block_sizes = { default_block_size_bytes };
+        batch_size = default_batch_size;
+        if (argc >= 4) {
             try {
-                block_size = std::stoi(argv[3]);
+                block_sizes.clear();
+                std::stringstream block_size_list(argv[3]);
+                std::string block_size;
+                while (std::getline(block_size_list, block_size, ',')) {
+                    block_sizes.push_back(std::stoi(block_size));
+                }
             }
             catch (const std::exception& ex) {
                 BOOST_LOG_TRIVIAL(error) << "Cannot parse block size " << argv[3] << ": " << ex.what();
-                return;
+                return false;
+            }
+        }
+        if (argc == 5) {
+            try {
+                batch_size = std::stoi(argv[4]);
+            }
+            catch (const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(error) << "Cannot parse batch size " << argv[4] << ": " << ex.what();
+                return false;
             }
         }
+        // Every resolution is hashed from blocks of the largest size, so the file is read only once
+        std::sort(block_sizes.begin(), block_sizes.end());
+        read_block_size = block_sizes.empty() ? 0 : block_sizes.back();
+        output_files.clear();
+        for (size_t block_size : block_sizes) {
+            output_files.push_back(block_sizes.size() == 1 ? output_file : output_file + "." + std::to_string(block_size));
+        }
+        return true;
     }
 
     bool validate_inputs() const
@@ -88,59 +130,211 @@ class SignatureApp
                 << " exceeds " << max_input_file_size_bytes << " bytes";
             result = false;
         }
-        if (std::filesystem::exists(output_file)) {
-            BOOST_LOG_TRIVIAL(error) << "Input file " << input_file << " already exists";
+        for (const std::string& output : output_files) {
+            if (std::filesystem::exists(output)) {
+                BOOST_LOG_TRIVIAL(error) << "Output file " << output << " already exists";
+                result = false;
+            }
+        }
+        if (output_files.size() != block_sizes.size()) {
+            BOOST_LOG_TRIVIAL(error) << "Number of output files does not match number of block sizes";
+            result = false;
+        }
+        if (block_sizes.empty() || block_sizes.size() > max_resolutions) {
+            BOOST_LOG_TRIVIAL(error) << "Number of block sizes must be between 1 and " << max_resolutions;
             result = false;
         }
-        if (block_size < 512 || block_size > 10 * 1024 * 1024) {
-            BOOST_LOG_TRIVIAL(error) << "Block size " << block_size << " is outside of allowed range: "
-                << min_block_size_bytes << " - " << max_block_size_bytes << " bytes";
+        for (size_t i = 0; i < block_sizes.size(); i++) {
+            size_t block_size = block_sizes[i];
+            if (block_size < min_block_size_bytes || block_size > max_block_size_bytes) {
+                BOOST_LOG_TRIVIAL(error) << "Block size " << block_size << " is outside of allowed range: "
+                    << min_block_size_bytes << " - " << max_block_size_bytes << " bytes";
+                result = false;
+            }
+            else if (read_block_size % block_size != 0) {
+                BOOST_LOG_TRIVIAL(error) << "Block size " << block_size << " does not divide the largest block size " << read_block_size;
+                result = false;
+            }
+            else if (i > 0 && block_sizes[i - 1] == block_size) {
+                BOOST_LOG_TRIVIAL(error) << "Block size " << block_size << " is specified more than once";
+                result = false;
+            }
+        }
+        if (batch_size < min_batch_size || batch_size > max_batch_size) {
+            BOOST_LOG_TRIVIAL(error) << "Batch size " << batch_size << " is outside of allowed range: "
+                << min_batch_size << " - " << max_batch_size << " blocks";
             result = false;
         }
         return result;
     }
 
+    // Cache is enabled by SIGNATURE_CACHE_DIR, its size is limited by SIGNATURE_CACHE_SIZE_MB
+    void set_up_cache()
+    {
+        const char* cache_dir = std::getenv("SIGNATURE_CACHE_DIR");
+        if (cache_dir == nullptr || *cache_dir == '\0') {
+            return;
+        }
+        uint64_t cache_size = default_cache_size_bytes;
+        const char* cache_size_mb = std::getenv("SIGNATURE_CACHE_SIZE_MB");
+        if (cache_size_mb != nullptr) {
+            try {
+                cache_size = std::stoull(cache_size_mb) * 1024ULL * 1024ULL;
+            }
+            catch (const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(error) << "Cannot parse cache size " << cache_size_mb << ": " << ex.what();
+                return;
+            }
+        }
+        cache = std::make_unique<SignatureCache>(cache_dir, cache_size);
+        cache_keys.clear();
+        for (size_t block_size : block_sizes) {
+            cache_keys.push_back(cache->make_key(input_file, block_size, hash_algorithm));
+            BOOST_LOG_TRIVIAL(debug) << "Signature cache: " << cache_dir << ", key: " << cache_keys.back();
+        }
+    }
+
+    // Either every resolution is taken from cache or none of them
+    bool fetch_cached_signature()
+    {
+        if (!cache) {
+            return false;
+        }
+        for (size_t i = 0; i < block_sizes.size(); i++) {
+            if (!cache->fetch(cache_keys[i], output_files[i])) {
+                for (size_t j = 0; j < i; j++) {
+                    std::filesystem::remove(output_files[j]);
+                }
+                return false;
+            }
+        }
+        BOOST_LOG_TRIVIAL(info) << "Signature taken from cache";
+        return true;
+    }
+
+    void store_cached_signature()
+    {
+        if (!cache) {
+            return;
+        }
+        for (size_t i = 0; i < block_sizes.size(); i++) {
+            // Input file could have changed while signature was being generated, or some task could have failed
+            if (cache->make_key(input_file, block_sizes[i], hash_algorithm) != cache_keys[i]) {
+                return;
+            }
+            // Input file could also be removed after the check, signature is valid but must not be cached then
+            std::error_code error;
+            uint64_t input_size = std::filesystem::file_size(input_file, error);
+            if (error) {
+                return;
+            }
+            uint64_t block_number = (input_size + block_sizes[i] - 1) / block_sizes[i];
+            if (std::filesystem::file_size(output_files[i], error) != block_number * (hash_size_bytes + 1) || error) {
+                continue;
+            }
+            cache->store(cache_keys[i], output_files[i]);
+        }
+    }
+
+    // Background mode is enabled by any of SIGNATURE_READ_LIMIT_MB (Mb/s), SIGNATURE_MAX_HASHERS, SIGNATURE_CONTROL_FILE
+    bool set_up_governor()
+    {
+        const char* read_limit_mb = std::getenv("SIGNATURE_READ_LIMIT_MB");
+        const char* max_hashers = std::getenv("SIGNATURE_MAX_HASHERS");
+        const char* control_file = std::getenv("SIGNATURE_CONTROL_FILE");
+        if (read_limit_mb == nullptr && max_hashers == nullptr && control_file == nullptr) {
+            return true;
+        }
+        double read_limit_bytes = 0;
+        size_t max_active_hashers = 0;
+        try {
+            if (read_limit_mb != nullptr) {
+                read_limit_bytes = std::stod(read_limit_mb) * 1024 * 1024;
+            }
+            if (max_hashers != nullptr) {
+                max_active_hashers = std::stoul(max_hashers);
+            }
+        }
+        catch (const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error) << "Cannot parse resource limits: " << ex.what();
+            return false;
+        }
+        governor = std::make_shared<ResourceGovernor>(read_limit_bytes, max_active_hashers, control_file != nullptr ? control_file : "");
+        ResourceGovernor::apply_background_priority();
+        ResourceGovernor::enable_reload_signal();
+        BOOST_LOG_TRIVIAL(info) << "Running in background mode, read limit: " << governor->get_read_limit() / (1024 * 1024)
+            << " Mb/s, max active hashers: " << governor->get_max_active_hashers() << " (0 means no limit)";
+        return true;
+    }
+
     void set_up_queues()
     {
         hasher_number = std::max(1U, 2 * std::thread::hardware_concurrency());
-        max_block_number = std::min(max_file_data_memory_consumption_bytes / (sizeof(FileBlock) + block_size), max_queue_elements_per_thread * hasher_number);
-        max_hash_number = std::min(max_hash_data_memory_consumption_bytes / (sizeof(BlockHash) + hash_size_bytes), max_queue_elements_per_thread * hasher_number);
-        write_grouping = std::min(max_write_data_memory_consumption_bytes / ((sizeof(FileBlockHashBuffer) + hash_size_bytes + 1) * hasher_number), max_write_grouping);
+        size_t resolutions = block_sizes.size();
+        max_block_number = std::min(max_file_data_memory_consumption_bytes / (sizeof(FileBlock) + read_block_size), max_queue_elements_per_thread * hasher_number);
+        max_hash_number = std::min(max_hash_data_memory_consumption_bytes / ((sizeof(BlockHash) + hash_size_bytes) * resolutions), max_queue_elements_per_thread * hasher_number);
+        // Many threads and resolutions could round the grouping down to 0, which writers divide by
+        write_grouping = std::max(min_write_grouping, std::min(max_write_data_memory_consumption_bytes / ((sizeof(FileBlockHashBuffer) + hash_size_bytes + 1) * hasher_number * resolutions), max_write_grouping));
+        // Reader and every hasher hold up to batch_size blocks outside of the queue
+        batch_size = std::max(min_batch_size, std::min(batch_size, max_batch_data_memory_consumption_bytes / ((sizeof(FileBlock) + read_block_size) * (hasher_number + 1))));
         file_block_queue = std::make_shared<BlockingQueue<FileBlock>>(max_block_number);
-        block_hash_queue = std::make_shared<BlockingQueue<BlockHash>>(max_hash_number);
+        block_hash_queues.clear();
+        for (size_t i = 0; i < resolutions; i++) {
+            block_hash_queues.push_back(std::make_shared<BlockingQueue<BlockHash>>(max_hash_number));
+        }
 
         BOOST_LOG_TRIVIAL(info) << "Generating file signature...";
         BOOST_LOG_TRIVIAL(info) << "Input file: " << input_file;
-        BOOST_LOG_TRIVIAL(info) << "Output file: " << output_file;
-        BOOST_LOG_TRIVIAL(info) << "Block size: " << block_size << " bytes";
+        for (size_t i = 0; i < resolutions; i++) {
+            BOOST_LOG_TRIVIAL(info) << "Output file: " << output_files[i] << ", block size: " << block_sizes[i] << " bytes";
+        }
         BOOST_LOG_TRIVIAL(debug) << "File block queue size: " << max_block_number;
         BOOST_LOG_TRIVIAL(debug) << "File hash queue size: " << max_hash_number;
         BOOST_LOG_TRIVIAL(debug) << "Write seek reduction factor: " << write_grouping;
+        BOOST_LOG_TRIVIAL(debug) << "Batch size: " << batch_size;
     }
 
-    void run_tasks()
+    // Returns false if any task failed, its output must not be trusted then
+    bool run_tasks()
     {
-        // Start tasks: FileBlockReader -> FileBlockHasherMD5 -> FileBlockHashWriter
+        auto task_failed = std::make_shared<std::atomic<bool>>(false);
+        // Start tasks: FileBlockReader -> FileBlockHasherMD5 -> FileBlockHashWriter (one per block size)
         // thread_pool is used for convenience only, threads match tasks one to one
-        boost::asio::thread_pool pool(hasher_number + 2);
-        boost::asio::post(pool, Task("Input file reader", std::make_unique<FileBlockReader>(file_block_queue, input_file, block_size)));
+        boost::asio::thread_pool pool(hasher_number + 1 + block_sizes.size());
+        boost::asio::post(pool, Task("Input file reader", std::make_unique<FileBlockReader>(file_block_queue, input_file, read_block_size, batch_size, governor), task_failed));
         for (size_t i = 0; i < hasher_number; i++) {
-            boost::asio::post(pool, Task("Hasher #" + std::to_string(i), std::make_unique<FileBlockHasherMD5>(file_block_queue, block_hash_queue)));
+            boost::asio::post(pool, Task("Hasher #" + std::to_string(i), std::make_unique<FileBlockHasherMD5>(file_block_queue, block_hash_queues, block_sizes, batch_size, governor), task_failed));
+        }
+        for (size_t i = 0; i < block_sizes.size(); i++) {
+            boost::asio::post(pool, Task("Output file writer #" + std::to_string(i), std::make_unique<FileBlockHashWriter>(block_hash_queues[i], output_files[i], write_grouping, batch_size), task_failed));
         }
-        boost::asio::post(pool, Task("Output file writer", std::make_unique<FileBlockHashWriter>(block_hash_queue, output_file, write_grouping)));
         pool.join();
+        if (governor) {
+            governor->report();
+        }
+        return !*task_failed;
     }
 
 public:
 	void run(int argc, char* argv[])
 	{
         init_logging();
-        process_args(argc, argv);
-        if (!validate_inputs()) {
+        if (!process_args(argc, argv) || !validate_inputs()) {
+            return;
+        }
+        set_up_cache();
+        if (fetch_cached_signature()) {
+            return;
+        }
+        if (!set_up_governor()) {
             return;
         }
         set_up_queues();
-        run_tasks();
+        if (!run_tasks()) {
+            BOOST_LOG_TRIVIAL(error) << "Signature generation failed";
+            return;
+        }
+        store_cached_signature();
         BOOST_LOG_TRIVIAL(info) << "Signature generated!";
 	}
 };
@@ -0,0 +1,45 @@
+#include "MemoryBlockHasherMD5.h"
+#include "FileBlockHasherMD5.h"
+#include <algorithm>
+
+MemoryBlockHasherMD5::MemoryBlockHasherMD5(const std::shared_ptr<MemorySigningJob>& job, const size_t hash_size)
+	: hash_size(hash_size), job(job)
+{}
+
+void MemoryBlockHasherMD5::on_start()
+{
+	// No logging, this worker runs on every MemorySigner::sign call of an embedding application
+}
+
+bool MemoryBlockHasherMD5::do_work()
+{
+	size_t first_block;
+	size_t count;
+	if (!job->claim_blocks(first_block, count)) {
+		return false;
+	}
+	// Claimed blocks must be reported as done even on failure, otherwise the caller waits forever
+	try {
+		for (size_t block = first_block; block < first_block + count; block++) {
+			std::string hash = FileBlockHasherMD5::md5_hash(job->get_block(block, block_buffer), job->get_block_size());
+			if (hash.size() != hash_size) {
+				throw std::runtime_error("Unexpected hash size " + std::to_string(hash.size()));
+			}
+			std::copy(hash.begin(), hash.end(), job->get_output(block, hash_size));
+		}
+	}
+	catch (const std::exception& ex) {
+		job->complete_blocks(count, ex.what());
+		return false;
+	}
+	job->complete_blocks(count);
+	return true;
+}
+
+void MemoryBlockHasherMD5::on_stop()
+{}
+
+MemoryBlockHasherMD5::~MemoryBlockHasherMD5()
+{
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "Worker.h"
+#include "data/MemorySigningJob.h"
+#include <memory>
+#include <vector>
+
+/*
+	Calculates MD5 hashes for blocks of a MemorySigningJob and writes them straight into its output,
+	batch of blocks at a time. Blocks are hashed in place unless they span several buffers or need padding
+*/
+class MemoryBlockHasherMD5 : public Worker
+{
+	const size_t hash_size;
+	std::shared_ptr<MemorySigningJob> job;
+	std::vector<char> block_buffer;
+
+public:
+	MemoryBlockHasherMD5(const std::shared_ptr<MemorySigningJob>& job, const size_t hash_size);
+	void on_start() override;
+	bool do_work() override;
+	void on_stop() override;
+	~MemoryBlockHasherMD5() override;
+};
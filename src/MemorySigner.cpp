@@ -0,0 +1,82 @@
+#include "MemorySigner.h"
+#include "MemoryBlockHasherMD5.h"
+#include "Task.h"
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	size_t default_hasher_number(size_t hasher_number)
+	{
+		return hasher_number > 0 ? hasher_number : std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	// Unlike Task, lets exceptions reach the caller
+	void run_worker(Worker& worker)
+	{
+		worker.on_start();
+		while (worker.do_work());
+		worker.on_stop();
+	}
+}
+
+MemorySigner::MemorySigner(size_t hasher_number, size_t batch_size)
+	: own_pool(std::make_unique<boost::asio::thread_pool>(default_hasher_number(hasher_number))), pool(*own_pool),
+	  hasher_number(default_hasher_number(hasher_number)), batch_size(std::max<size_t>(batch_size, 1))
+{}
+
+MemorySigner::MemorySigner(boost::asio::thread_pool& pool, size_t hasher_number, size_t batch_size)
+	: pool(pool), hasher_number(default_hasher_number(hasher_number)), batch_size(std::max<size_t>(batch_size, 1))
+{}
+
+MemorySigner::~MemorySigner()
+{
+	if (own_pool) {
+		own_pool->join();
+	}
+}
+
+size_t MemorySigner::get_signature_size(size_t data_size, size_t block_size)
+{
+	if (block_size == 0) {
+		throw std::runtime_error("Block size must be positive");
+	}
+	return (data_size + block_size - 1) / block_size * hash_size_bytes;
+}
+
+void MemorySigner::sign(const char* data, size_t data_size, size_t block_size, char* output, size_t output_size) const
+{
+	sign(std::vector<ConstBuffer>{ ConstBuffer(data, data_size) }, block_size, output, output_size);
+}
+
+void MemorySigner::sign(const std::vector<ConstBuffer>& buffers, size_t block_size, char* output, size_t output_size) const
+{
+	size_t data_size = 0;
+	for (const ConstBuffer& buffer : buffers) {
+		data_size += buffer.size;
+	}
+	size_t signature_size = get_signature_size(data_size, block_size);
+	if (output_size < signature_size) {
+		throw std::runtime_error("Output buffer size " + std::to_string(output_size) + " is less than required "
+			+ std::to_string(signature_size) + " bytes");
+	}
+	size_t block_number = signature_size / hash_size_bytes;
+	if (block_number == 0) {
+		return;
+	}
+
+	auto job = std::make_shared<MemorySigningJob>(buffers, block_size, block_number, batch_size, output);
+	size_t helper_number = std::min(hasher_number, (block_number + batch_size - 1) / batch_size - 1);
+	for (size_t i = 0; i < helper_number; i++) {
+		boost::asio::post(pool, Task("Memory hasher #" + std::to_string(i), std::make_unique<MemoryBlockHasherMD5>(job, hash_size_bytes)));
+	}
+	// Calling thread hashes as well, so the job progresses even if no helper gets a thread
+	MemoryBlockHasherMD5 hasher(job, hash_size_bytes);
+	run_worker(hasher);
+	std::string error = job->wait();
+	if (!error.empty()) {
+		throw std::runtime_error("Signature generation failed: " + error);
+	}
+}
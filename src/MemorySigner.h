@@ -0,0 +1,38 @@
+#pragma once
+#include "data/ConstBuffer.h"
+#include <boost/asio/thread_pool.hpp>
+#include <memory>
+#include <vector>
+
+/*
+	In-process signature generation over memory buffers, without temporary files.
+	Blocks are hashed by MemoryBlockHasherMD5 workers straight from the buffers into the output,
+	so memory use does not grow with input size. The calling thread always hashes too, and helper
+	hashers run on a thread pool that is created once per signer or supplied by the caller.
+	Helpers only pick up work that is still left when they start, so sign() completes even if
+	the pool is busy or sign() is called from one of its threads.
+	Concurrent calls are safe, but calls sharing a pool compete for its threads.
+	No logging is done on success and logging configuration is left to the caller.
+	Output is hash_size_bytes hex characters per block, in block order, without separators
+*/
+class MemorySigner
+{
+	std::unique_ptr<boost::asio::thread_pool> own_pool;
+	boost::asio::thread_pool& pool;
+	const size_t hasher_number;
+	const size_t batch_size;
+
+public:
+	static constexpr const size_t hash_size_bytes = 32;
+	static constexpr const size_t default_batch_size = 64;
+
+	// Creates its own pool with hasher_number threads (0 means number of hardware threads)
+	explicit MemorySigner(size_t hasher_number = 0, size_t batch_size = default_batch_size);
+	// Uses an existing pool, posting up to hasher_number helper hashers into it per call
+	MemorySigner(boost::asio::thread_pool& pool, size_t hasher_number, size_t batch_size = default_batch_size);
+	~MemorySigner();
+
+	static size_t get_signature_size(size_t data_size, size_t block_size);
+	void sign(const char* data, size_t data_size, size_t block_size, char* output, size_t output_size) const;
+	void sign(const std::vector<ConstBuffer>& buffers, size_t block_size, char* output, size_t output_size) const;
+};
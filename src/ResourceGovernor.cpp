@@ -0,0 +1,241 @@
+#include "ResourceGovernor.h"
+#include <boost/log/trivial.hpp>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+#include <csignal>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	std::atomic<bool> reload_requested = false;
+
+	void request_reload(int)
+	{
+		reload_requested = true;
+	}
+
+	std::string format_limit(double limit)
+	{
+		if (limit <= 0) {
+			return "none";
+		}
+		std::ostringstream result;
+		result << limit;
+		return result.str();
+	}
+
+	double get_cpu_seconds()
+	{
+#ifdef _WIN32
+		return 0;
+#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) {
+			return 0;
+		}
+		return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+	}
+}
+
+ResourceGovernor::ResourceGovernor(double read_limit_bytes_per_second, size_t max_active_hashers, const std::string& control_file)
+	: control_file(control_file), read_limit_bytes_per_second(read_limit_bytes_per_second), max_active_hashers(max_active_hashers),
+	  start_time(clock::now()), last_refill_time(start_time), last_control_check_time(start_time), last_report_time(start_time)
+{
+	if (!control_file.empty()) {
+		load_control_file();
+	}
+}
+
+void ResourceGovernor::refill_read_tokens(clock::time_point now)
+{
+	std::chrono::duration<double> elapsed = now - last_refill_time;
+	last_refill_time = now;
+	if (read_limit_bytes_per_second <= 0) {
+		read_tokens = 0;
+		return;
+	}
+	// Bucket holds at most one second worth of reads
+	read_tokens = std::min(read_tokens + elapsed.count() * read_limit_bytes_per_second, read_limit_bytes_per_second);
+}
+
+void ResourceGovernor::check_control_file(clock::time_point now)
+{
+	if (now - last_report_time >= report_interval) {
+		report_locked(now);
+	}
+	if (now - last_control_check_time < control_check_interval && !reload_requested) {
+		return;
+	}
+	last_control_check_time = now;
+	bool reload = reload_requested.exchange(false);
+	if (!control_file.empty()) {
+		std::error_code error;
+		auto file_time = std::filesystem::last_write_time(control_file, error);
+		if (!error && file_time != control_file_time) {
+			reload = true;
+		}
+	}
+	if (reload) {
+		load_control_file();
+		report_locked(now);
+		limits_changed_event.notify_all();
+	}
+}
+
+void ResourceGovernor::load_control_file()
+{
+	if (control_file.empty()) {
+		return;
+	}
+	std::error_code error;
+	control_file_time = std::filesystem::last_write_time(control_file, error);
+	std::ifstream file(control_file);
+	if (error || !file) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot read control file " << control_file;
+		return;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t separator = line.find('=');
+		if (line.empty() || line[0] == '#' || separator == std::string::npos) {
+			continue;
+		}
+		std::string key = line.substr(0, separator);
+		std::string value = line.substr(separator + 1);
+		try {
+			if (key == "read_limit_mb") {
+				read_limit_bytes_per_second = std::max(0.0, std::stod(value)) * bytes_per_mb;
+			}
+			else if (key == "max_hashers") {
+				max_active_hashers = std::stoul(value);
+			}
+			else {
+				BOOST_LOG_TRIVIAL(warning) << "Unknown control file setting " << key;
+			}
+		}
+		catch (const std::exception& ex) {
+			BOOST_LOG_TRIVIAL(warning) << "Cannot parse control file setting " << line << ": " << ex.what();
+		}
+	}
+}
+
+void ResourceGovernor::acquire_read(size_t bytes)
+{
+	std::unique_lock lock(governor_mutex);
+	bytes_read += bytes;
+	read_tokens -= bytes;
+	while (true) {
+		auto now = clock::now();
+		check_control_file(now);
+		refill_read_tokens(now);
+		if (read_tokens >= 0 || read_limit_bytes_per_second <= 0) {
+			break;
+		}
+		std::chrono::duration<double> wait_time(-read_tokens / read_limit_bytes_per_second);
+		limits_changed_event.wait_for(lock, std::min<std::chrono::duration<double>>(wait_time, max_wait_interval));
+		read_throttled_seconds += std::chrono::duration<double>(clock::now() - now).count();
+	}
+}
+
+void ResourceGovernor::acquire_hasher()
+{
+	std::unique_lock lock(governor_mutex);
+	while (true) {
+		auto now = clock::now();
+		check_control_file(now);
+		if (max_active_hashers == 0 || active_hashers < max_active_hashers) {
+			break;
+		}
+		limits_changed_event.wait_for(lock, max_wait_interval);
+		hasher_throttled_seconds += std::chrono::duration<double>(clock::now() - now).count();
+	}
+	active_hashers++;
+	max_seen_active_hashers = std::max(max_seen_active_hashers, active_hashers);
+}
+
+void ResourceGovernor::release_hasher()
+{
+	std::unique_lock lock(governor_mutex);
+	active_hashers--;
+	limits_changed_event.notify_all();
+}
+
+void ResourceGovernor::report_locked(clock::time_point now)
+{
+	last_report_time = now;
+	double elapsed = std::max(std::chrono::duration<double>(now - start_time).count(), 1e-3);
+	BOOST_LOG_TRIVIAL(info) << "Resource usage: read " << bytes_read / bytes_per_mb / elapsed << " Mb/s (limit "
+		<< format_limit(read_limit_bytes_per_second / bytes_per_mb) << "), "
+		<< "CPU " << get_cpu_seconds() / elapsed << " cores, "
+		<< "hashers active " << active_hashers << ", peak " << max_seen_active_hashers << " (limit "
+		<< format_limit(static_cast<double>(max_active_hashers)) << "), "
+		<< "throttled reads " << read_throttled_seconds << " s, hashers " << hasher_throttled_seconds << " s";
+}
+
+void ResourceGovernor::report()
+{
+	std::unique_lock lock(governor_mutex);
+	report_locked(clock::now());
+}
+
+const double ResourceGovernor::get_read_limit() const
+{
+	std::unique_lock lock(governor_mutex);
+	return read_limit_bytes_per_second;
+}
+
+const size_t ResourceGovernor::get_max_active_hashers() const
+{
+	std::unique_lock lock(governor_mutex);
+	return max_active_hashers;
+}
+
+void ResourceGovernor::apply_background_priority()
+{
+#ifdef __linux__
+	sched_param param{};
+	if (sched_setscheduler(0, SCHED_IDLE, &param) != 0) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot set idle CPU scheduling policy";
+	}
+	// ioprio_set has no glibc wrapper: IOPRIO_WHO_PROCESS, IOPRIO_CLASS_IDLE
+	static constexpr const int ioprio_who_process = 1;
+	static constexpr const int ioprio_class_idle = 3;
+	static constexpr const int ioprio_class_shift = 13;
+	if (syscall(SYS_ioprio_set, ioprio_who_process, 0, ioprio_class_idle << ioprio_class_shift) != 0) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot set idle I/O priority";
+	}
+#else
+	BOOST_LOG_TRIVIAL(warning) << "Background scheduling priorities are not supported on this platform";
+#endif
+}
+
+void ResourceGovernor::enable_reload_signal()
+{
+#ifdef SIGHUP
+	std::signal(SIGHUP, request_reload);
+#endif
+}
+
+HasherSlot::HasherSlot(ResourceGovernor* governor)
+	: governor(governor)
+{
+	if (governor) {
+		governor->acquire_hasher();
+	}
+}
+
+HasherSlot::~HasherSlot()
+{
+	if (governor) {
+		governor->release_hasher();
+	}
+}
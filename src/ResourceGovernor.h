@@ -0,0 +1,75 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <filesystem>
+
+/*
+	Limits resources used by the pipeline in background mode:
+	reader throughput (token bucket, bytes per second) and number of hashers working at the same time.
+	Zero means no limit. Limits are reloaded from control_file ("read_limit_mb=N", "max_hashers=N" lines)
+	when it changes or when the process receives SIGHUP, usage is reported against limits periodically
+*/
+class ResourceGovernor
+{
+	static constexpr const std::chrono::seconds control_check_interval{ 1 };
+	static constexpr const std::chrono::seconds report_interval{ 10 };
+	static constexpr const std::chrono::milliseconds max_wait_interval{ 100 };
+	static constexpr const double bytes_per_mb = 1024.0 * 1024.0;
+	using clock = std::chrono::steady_clock;
+
+	mutable std::mutex governor_mutex;
+	std::condition_variable limits_changed_event;
+	const std::string control_file;
+	std::filesystem::file_time_type control_file_time;
+
+	double read_limit_bytes_per_second;
+	size_t max_active_hashers;
+	double read_tokens = 0;
+	size_t active_hashers = 0;
+
+	// Usage statistics
+	const clock::time_point start_time;
+	clock::time_point last_refill_time;
+	clock::time_point last_control_check_time;
+	clock::time_point last_report_time;
+	uint64_t bytes_read = 0;
+	size_t max_seen_active_hashers = 0;
+	double read_throttled_seconds = 0;
+	double hasher_throttled_seconds = 0;
+
+	void refill_read_tokens(clock::time_point now);
+	void check_control_file(clock::time_point now);
+	void load_control_file();
+	void report_locked(clock::time_point now);
+
+public:
+	ResourceGovernor(double read_limit_bytes_per_second, size_t max_active_hashers, const std::string& control_file = "");
+	// Accounts for bytes read, blocks while reader exceeds its limit
+	void acquire_read(size_t bytes);
+	// Blocks until a hasher slot is free
+	void acquire_hasher();
+	void release_hasher();
+	void report();
+	const double get_read_limit() const;
+	const size_t get_max_active_hashers() const;
+
+	// Moves the calling thread to idle CPU and I/O scheduling classes where available,
+	// threads started afterwards inherit them
+	static void apply_background_priority();
+	// Reload limits on SIGHUP, where available
+	static void enable_reload_signal();
+};
+
+/*
+	Holds a hasher slot of ResourceGovernor for its lifetime (no-op without governor)
+*/
+class HasherSlot
+{
+	ResourceGovernor* const governor;
+
+public:
+	explicit HasherSlot(ResourceGovernor* governor);
+	~HasherSlot();
+};
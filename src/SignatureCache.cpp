@@ -0,0 +1,241 @@
+#include "SignatureCache.h"
+#include <boost/log/trivial.hpp>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#endif
+
+SignatureCache::SignatureCache(const std::string& cache_dir, uint64_t max_size_bytes)
+	: cache_dir(cache_dir), max_size_bytes(max_size_bytes)
+{
+#ifdef _WIN32
+	BOOST_LOG_TRIVIAL(warning) << "Signature cache is not supported on this platform";
+#else
+	std::error_code error;
+	std::filesystem::create_directories(cache_dir, error);
+	if (error) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot create signature cache directory " << cache_dir << ": " << error.message();
+		return;
+	}
+	is_enabled = true;
+#endif
+}
+
+std::string SignatureCache::get_entry_path(const std::string& key) const
+{
+	return (std::filesystem::path(cache_dir) / (key + entry_extension)).string();
+}
+
+std::string SignatureCache::make_key(const std::string& input_file, size_t block_size, const std::string& algorithm) const
+{
+#ifdef _WIN32
+	return "";
+#else
+	struct stat file_stat;
+	if (!is_enabled || stat(input_file.c_str(), &file_stat) != 0) {
+		return "";
+	}
+	return std::to_string(file_stat.st_dev) + "-" + std::to_string(file_stat.st_ino) + "-" + std::to_string(file_stat.st_size)
+		+ "-" + std::to_string(file_stat.st_mtim.tv_sec) + "." + std::to_string(file_stat.st_mtim.tv_nsec)
+		+ "-" + std::to_string(file_stat.st_ctim.tv_sec) + "." + std::to_string(file_stat.st_ctim.tv_nsec)
+		+ "-" + std::to_string(block_size) + "-" + algorithm;
+#endif
+}
+
+bool SignatureCache::fetch(const std::string& key, const std::string& output_file)
+{
+#ifdef _WIN32
+	return false;
+#else
+	if (!is_enabled || key.empty()) {
+		return false;
+	}
+	// Entry may be evicted by another process at any moment, the open descriptor still reads it completely
+	std::string entry_path = get_entry_path(key);
+	int entry = open(entry_path.c_str(), O_RDONLY);
+	if (entry < 0) {
+		return false;
+	}
+	futimens(entry, nullptr);
+	bool result = copy_file_contents(entry, output_file);
+	close(entry);
+	if (!result) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot copy cached signature " << entry_path << " to " << output_file;
+	}
+	return result;
+#endif
+}
+
+void SignatureCache::store(const std::string& key, const std::string& signature_file)
+{
+#ifndef _WIN32
+	if (!is_enabled || key.empty()) {
+		return;
+	}
+	std::string entry_path = get_entry_path(key);
+	std::string temp_path = entry_path + temp_extension + std::to_string(getpid());
+	std::error_code error;
+	std::filesystem::remove(temp_path, error);
+	if (!copy_file_contents(signature_file, temp_path)) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot store signature in cache " << cache_dir;
+		return;
+	}
+	std::filesystem::rename(temp_path, entry_path, error);
+	if (error) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot store signature in cache " << cache_dir << ": " << error.message();
+		std::filesystem::remove(temp_path, error);
+		return;
+	}
+	evict();
+#endif
+}
+
+void SignatureCache::evict()
+{
+#ifndef _WIN32
+	// Serialize eviction between processes, readers and writers do not need the lock
+	std::string lock_path = (std::filesystem::path(cache_dir) / lock_file_name).string();
+	int lock = open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (lock < 0 || flock(lock, LOCK_EX) != 0) {
+		BOOST_LOG_TRIVIAL(warning) << "Cannot lock signature cache " << cache_dir << ": " << std::strerror(errno);
+		if (lock >= 0) {
+			close(lock);
+		}
+		return;
+	}
+
+	struct Entry
+	{
+		std::filesystem::path path;
+		uint64_t size;
+		std::filesystem::file_time_type last_used;
+	};
+	std::vector<Entry> entries;
+	uint64_t total_size = 0;
+	std::error_code error;
+	auto now = std::filesystem::file_time_type::clock::now();
+	for (const auto& file : std::filesystem::directory_iterator(cache_dir, error)) {
+		bool is_entry = file.path().extension() == entry_extension;
+		bool is_temp = file.path().filename().string().find(std::string(entry_extension) + temp_extension) != std::string::npos;
+		if (!is_entry && !is_temp) {
+			continue;
+		}
+		Entry entry{ file.path(), file.file_size(error), file.last_write_time(error) };
+		if (error) {
+			continue;
+		}
+		// Temp files count against the size limit, but only stale ones may be removed
+		if (is_temp) {
+			if (now - entry.last_used > stale_temp_file_age && std::filesystem::remove(entry.path, error)) {
+				BOOST_LOG_TRIVIAL(debug) << "Removed stale " << entry.path.string() << " from signature cache";
+			}
+			else {
+				total_size += entry.size;
+			}
+			continue;
+		}
+		entries.push_back(entry);
+		total_size += entry.size;
+	}
+	if (total_size > max_size_bytes) {
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+		for (const Entry& entry : entries) {
+			if (total_size <= max_size_bytes) {
+				break;
+			}
+			if (std::filesystem::remove(entry.path, error)) {
+				BOOST_LOG_TRIVIAL(debug) << "Evicted " << entry.path.string() << " from signature cache";
+				total_size -= entry.size;
+			}
+		}
+	}
+	flock(lock, LOCK_UN);
+	close(lock);
+#endif
+}
+
+const bool SignatureCache::get_enabled() const
+{
+	return is_enabled;
+}
+
+bool SignatureCache::copy_file_contents(const std::string& input_file, const std::string& output_file)
+{
+#ifdef _WIN32
+	std::error_code error;
+	return std::filesystem::copy_file(input_file, output_file, error);
+#else
+	int input = open(input_file.c_str(), O_RDONLY);
+	if (input < 0) {
+		return false;
+	}
+	bool result = copy_file_contents(input, output_file);
+	close(input);
+	return result;
+#endif
+}
+
+#ifndef _WIN32
+bool SignatureCache::copy_file_contents(int input, const std::string& output_file)
+{
+	int output = open(output_file.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (output < 0) {
+		return false;
+	}
+	bool result = false;
+#ifdef FICLONE
+	// Shares extents with the source on filesystems supporting reflinks
+	result = ioctl(output, FICLONE, input) == 0;
+#endif
+	if (!result) {
+		result = true;
+		bool use_copy_file_range = true;
+		std::vector<char> buffer;
+		while (true) {
+			ssize_t bytes_copied = -1;
+#ifdef __linux__
+			if (use_copy_file_range) {
+				bytes_copied = copy_file_range(input, nullptr, output, nullptr, 1024 * 1024 * 1024, 0);
+				if (bytes_copied < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+					use_copy_file_range = false;
+				}
+			}
+#else
+			use_copy_file_range = false;
+#endif
+			if (!use_copy_file_range) {
+				buffer.resize(1024 * 1024);
+				bytes_copied = read(input, buffer.data(), buffer.size());
+				if (bytes_copied > 0 && write(output, buffer.data(), bytes_copied) != bytes_copied) {
+					bytes_copied = -1;
+				}
+			}
+			if (bytes_copied == 0) {
+				break;
+			}
+			if (bytes_copied < 0) {
+				result = false;
+				break;
+			}
+		}
+	}
+	result = close(output) == 0 && result;
+	// Only the file created here is removed, an existing output_file is never touched
+	if (!result) {
+		unlink(output_file.c_str());
+	}
+	return result;
+}
+#endif
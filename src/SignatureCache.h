@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <chrono>
+
+/*
+	Optional on-disk cache of generated signatures, keyed by input file identity
+	(device, inode, size, mtime, ctime) plus block size and hash algorithm.
+	Every entry is a separate signature file in cache_dir, published with an atomic rename,
+	so several processes may use the same cache concurrently. Entry modification time is
+	refreshed on every hit and used for LRU eviction once total size exceeds max_size_bytes.
+	Cache errors are logged and never fail signature generation. Only supported on POSIX systems
+*/
+class SignatureCache
+{
+	static constexpr const char* entry_extension = ".sig";
+	static constexpr const char* temp_extension = ".tmp";
+	static constexpr const char* lock_file_name = "lock";
+	// Temp files of processes killed before publishing their entry are removed after this time
+	static constexpr const std::chrono::hours stale_temp_file_age{ 1 };
+	const std::string cache_dir;
+	const uint64_t max_size_bytes;
+	bool is_enabled = false;
+
+	std::string get_entry_path(const std::string& key) const;
+	void evict();
+#ifndef _WIN32
+	// Copies from an open descriptor, removes output_file on failure only if it was created by this call
+	static bool copy_file_contents(int input, const std::string& output_file);
+#endif
+
+public:
+	SignatureCache(const std::string& cache_dir, uint64_t max_size_bytes);
+	// Returns empty string if the file identity cannot be determined
+	std::string make_key(const std::string& input_file, size_t block_size, const std::string& algorithm) const;
+	// Copies cached signature into (not yet existing) output_file, returns false on cache miss
+	bool fetch(const std::string& key, const std::string& output_file);
+	void store(const std::string& key, const std::string& signature_file);
+	const bool get_enabled() const;
+
+	// Copies file contents using reflink or in-kernel copy where available, fails if output_file exists
+	static bool copy_file_contents(const std::string& input_file, const std::string& output_file);
+};
@@ -3,8 +3,8 @@
 #include <exception>
 #include <iostream>
 
-Task::Task(const std::string& name, std::unique_ptr<Worker> worker)
-	: name(name), worker(std::move(worker))
+Task::Task(const std::string& name, std::unique_ptr<Worker> worker, const std::shared_ptr<std::atomic<bool>>& failed)
+	: name(name), worker(std::move(worker)), failed(failed)
 {}
 
 void Task::operator()()
@@ -16,8 +16,17 @@ void Task::operator()()
 	}
 	catch (const std::exception& ex) {
 		BOOST_LOG_TRIVIAL(error) << "Unhandled exception during task [" << name << "] execution! " << ex.what();
+		set_failed();
 	}
 	catch (...) {
 		BOOST_LOG_TRIVIAL(error) << "Unhandled exception during task [" << name << "] execution!";
+		set_failed();
+	}
+}
+
+void Task::set_failed()
+{
+	if (failed) {
+		*failed = true;
 	}
 }
\ No newline at end of file
@@ -3,13 +3,18 @@
 #include <memory>
 #include <utility>
 #include <string>
+#include <atomic>
 
 class Task
 {
 	const std::string name;
 	std::unique_ptr<Worker> worker;
+	// Set if the worker throws, optional
+	std::shared_ptr<std::atomic<bool>> failed;
+
+	void set_failed();
 
 public:
-	Task(const std::string& name, std::unique_ptr<Worker> worker);
+	Task(const std::string& name, std::unique_ptr<Worker> worker, const std::shared_ptr<std::atomic<bool>>& failed = nullptr);
 	void operator()();
 };
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+/*
+	Unit of work executed by Task. do_work processes one batch of items
+	(up to the worker's batch size) and returns false once there is nothing left to do
+*/
 class Worker
 {
 public:
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+/*
+	Read-only view of a caller-owned memory region (scatter-gather element, like iovec)
+*/
+struct ConstBuffer
+{
+	const char* data;
+	size_t size;
+
+	ConstBuffer() = default;
+	ConstBuffer(const char* data, size_t size)
+		: data(data), size(size)
+	{}
+};
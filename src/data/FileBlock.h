@@ -6,11 +6,13 @@ struct FileBlock
 {
 	size_t position;
 	size_t size;
+	// Bytes actually read, the rest of the block is zero padding
+	size_t data_size;
 	std::unique_ptr<char[]> data;
 
 	FileBlock() = default;
 	FileBlock(size_t position, size_t size)
-		: position(position), size(size)
+		: position(position), size(size), data_size(size)
 	{
 		data = std::make_unique<char[]>(size);
 	}
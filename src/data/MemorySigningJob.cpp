@@ -0,0 +1,71 @@
+#include "MemorySigningJob.h"
+#include <algorithm>
+
+MemorySigningJob::MemorySigningJob(const std::vector<ConstBuffer>& buffers, size_t block_size, size_t block_number, size_t batch_size, char* output)
+	: buffers(buffers), block_size(block_size), block_number(block_number), batch_size(batch_size), output(output)
+{
+	size_t offset = 0;
+	for (const ConstBuffer& buffer : buffers) {
+		buffer_offsets.push_back(offset);
+		offset += buffer.size;
+	}
+}
+
+bool MemorySigningJob::claim_blocks(size_t& first_block, size_t& count)
+{
+	first_block = next_block.fetch_add(batch_size);
+	if (first_block >= block_number) {
+		return false;
+	}
+	count = std::min(batch_size, block_number - first_block);
+	return true;
+}
+
+void MemorySigningJob::complete_blocks(size_t count, const std::string& block_error)
+{
+	std::unique_lock lock(done_mutex);
+	blocks_done += count;
+	if (error.empty()) {
+		error = block_error;
+	}
+	if (blocks_done == block_number) {
+		blocks_done_event.notify_all();
+	}
+}
+
+std::string MemorySigningJob::wait()
+{
+	std::unique_lock lock(done_mutex);
+	while (blocks_done < block_number) {
+		blocks_done_event.wait(lock);
+	}
+	return error;
+}
+
+const char* MemorySigningJob::get_block(size_t block, std::vector<char>& block_buffer) const
+{
+	size_t offset = block * block_size;
+	size_t buffer_index = std::upper_bound(buffer_offsets.begin(), buffer_offsets.end(), offset) - buffer_offsets.begin() - 1;
+	size_t buffer_offset = offset - buffer_offsets[buffer_index];
+	if (buffers[buffer_index].size - buffer_offset >= block_size) {
+		return buffers[buffer_index].data + buffer_offset;
+	}
+	block_buffer.assign(block_size, 0);
+	size_t bytes_copied = 0;
+	for (; bytes_copied < block_size && buffer_index < buffers.size(); buffer_index++, buffer_offset = 0) {
+		size_t bytes_to_copy = std::min(block_size - bytes_copied, buffers[buffer_index].size - buffer_offset);
+		std::copy_n(buffers[buffer_index].data + buffer_offset, bytes_to_copy, block_buffer.data() + bytes_copied);
+		bytes_copied += bytes_to_copy;
+	}
+	return block_buffer.data();
+}
+
+char* MemorySigningJob::get_output(size_t block, size_t hash_size) const
+{
+	return output + block * hash_size;
+}
+
+const size_t MemorySigningJob::get_block_size() const
+{
+	return block_size;
+}
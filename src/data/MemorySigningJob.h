@@ -0,0 +1,39 @@
+#pragma once
+#include "ConstBuffer.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+
+/*
+	Shared state of one MemorySigner::sign call. Hashers claim batches of blocks from it
+	and report them as done, so the job completes with any number of hashers (at least one)
+*/
+class MemorySigningJob
+{
+	const std::vector<ConstBuffer> buffers;
+	std::vector<size_t> buffer_offsets;
+	const size_t block_size;
+	const size_t block_number;
+	const size_t batch_size;
+	char* const output;
+
+	std::atomic<size_t> next_block = 0;
+	std::mutex done_mutex;
+	std::condition_variable blocks_done_event;
+	size_t blocks_done = 0;
+	std::string error;
+
+public:
+	MemorySigningJob(const std::vector<ConstBuffer>& buffers, size_t block_size, size_t block_number, size_t batch_size, char* output);
+	// Returns false once every block has been claimed
+	bool claim_blocks(size_t& first_block, size_t& count);
+	void complete_blocks(size_t count, const std::string& block_error = "");
+	// Waits until every claimed block is done, returns the first error if any
+	std::string wait();
+	// Returns pointer to block data, copying it into block_buffer (zero padded) if it is not contiguous or not full
+	const char* get_block(size_t block, std::vector<char>& block_buffer) const;
+	char* get_output(size_t block, size_t hash_size) const;
+	const size_t get_block_size() const;
+};
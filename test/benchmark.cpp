@@ -0,0 +1,80 @@
+#include <boost/asio.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "../src/BlockingQueue.hpp"
+#include "../src/FileBlockReader.h"
+#include "../src/FileBlockHasherMD5.h"
+#include "../src/FileBlockHashWriter.h"
+#include "../src/Task.h"
+
+/*
+	Measures end-to-end pipeline throughput for small blocks at different batch sizes
+	Usage: Benchmark [input_size_mb (default value: 64)] [block_size_bytes (default value: 512)]
+*/
+
+static const std::string input_file = "benchmark.bin";
+static const std::string output_file = "benchmark.txt";
+
+void generate_input(size_t size_bytes)
+{
+    std::mt19937 generator(42);
+    std::vector<char> data(1024 * 1024);
+    std::ofstream file(input_file, std::ios::binary);
+    for (size_t written = 0; written < size_bytes; written += data.size()) {
+        for (char& c : data) {
+            c = static_cast<char>(generator());
+        }
+        file.write(data.data(), std::min(data.size(), size_bytes - written));
+    }
+}
+
+double run_pipeline(size_t block_size, size_t batch_size)
+{
+    static constexpr const size_t queue_size = 16 * 1024;
+    static constexpr const size_t write_grouping = 128;
+    size_t hasher_number = std::max(1U, 2 * std::thread::hardware_concurrency());
+    auto file_block_queue = std::make_shared<BlockingQueue<FileBlock>>(queue_size);
+    auto block_hash_queue = std::make_shared<BlockingQueue<BlockHash>>(queue_size);
+    std::filesystem::remove(output_file);
+
+    auto start = std::chrono::steady_clock::now();
+    boost::asio::thread_pool pool(hasher_number + 2);
+    boost::asio::post(pool, Task("Input file reader", std::make_unique<FileBlockReader>(file_block_queue, input_file, block_size, batch_size)));
+    for (size_t i = 0; i < hasher_number; i++) {
+        boost::asio::post(pool, Task("Hasher #" + std::to_string(i), std::make_unique<FileBlockHasherMD5>(file_block_queue, block_hash_queue, batch_size)));
+    }
+    boost::asio::post(pool, Task("Output file writer", std::make_unique<FileBlockHashWriter>(block_hash_queue, output_file, write_grouping, batch_size)));
+    pool.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+    boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
+    size_t input_size_mb = argc > 1 ? std::stoul(argv[1]) : 64;
+    size_t block_size = argc > 2 ? std::stoul(argv[2]) : 512;
+    generate_input(input_size_mb * 1024 * 1024);
+
+    std::cout << "Input: " << input_size_mb << " Mb, block size: " << block_size << " bytes" << std::endl;
+    double baseline = 0;
+    for (size_t batch_size : { 1, 4, 16, 64, 256, 1024 }) {
+        double seconds = run_pipeline(block_size, batch_size);
+        if (batch_size == 1) {
+            baseline = seconds;
+        }
+        std::cout << "Batch size " << batch_size << ": " << seconds << " s, "
+            << input_size_mb / seconds << " Mb/s, x" << baseline / seconds << std::endl;
+    }
+
+    std::filesystem::remove(input_file);
+    std::filesystem::remove(output_file);
+}
@@ -3,11 +3,15 @@
 #include <boost/asio.hpp>
 #include <functional>
 #include <filesystem>
+#include <thread>
 
 #include "../src/BlockingQueue.hpp"
 #include "../src/FileBlockReader.h"
 #include "../src/FileBlockHasherMD5.h"
 #include "../src/FileBlockHashWriter.h"
+#include "../src/MemorySigner.h"
+#include "../src/ResourceGovernor.h"
+#include "../src/SignatureCache.h"
 #include "../src/Task.h"
 
 std::atomic<size_t> entries_read = 0;
@@ -122,4 +126,257 @@ BOOST_AUTO_TEST_CASE(FileBlockHashWriterTest, *boost::unit_test::timeout(5))
     t.close();
     std::filesystem::remove("test.txt");
     BOOST_CHECK_EQUAL("DEADBEEF\nCAFEBABE\n", result);
-}
\ No newline at end of file
+}
+
+void bulk_reader_task(BlockingQueue<int>& queue)
+{
+    std::vector<int> batch;
+    while (queue.pop_bulk(batch, 64)) {
+        entries_read += batch.size();
+    }
+}
+
+void bulk_writer_task(BlockingQueue<int>& queue)
+{
+    queue.start_writing();
+    std::vector<int> batch;
+    for (size_t i = 0; i < 100000; i++) {
+        batch.push_back(rand());
+        if (batch.size() == 100) {
+            queue.push_bulk(batch);
+        }
+    }
+    queue.push_bulk(batch);
+    queue.stop_writing();
+}
+
+BOOST_AUTO_TEST_CASE(QueueBulkTest, *boost::unit_test::timeout(5))
+{
+    entries_read = 0;
+    BlockingQueue<int> queue(1000);
+    boost::asio::thread_pool pool(10);
+    for (size_t i = 0; i < 5; i++) {
+        boost::asio::post(pool, std::bind(bulk_reader_task, std::ref(queue)));
+        boost::asio::post(pool, std::bind(bulk_writer_task, std::ref(queue)));
+    }
+    pool.join();
+    BOOST_CHECK_EQUAL(5 * 100000, entries_read);
+}
+
+BOOST_AUTO_TEST_CASE(FileReaderBatchTest, *boost::unit_test::timeout(5))
+{
+    std::shared_ptr<BlockingQueue<FileBlock>> queue = std::make_shared<BlockingQueue<FileBlock>>(2);
+    std::ofstream test_file_out("test.bin", std::ios::binary);
+    test_file_out.write("qwert", 5);
+    test_file_out.close();
+    std::unique_ptr<Worker> file_reader = std::make_unique<FileBlockReader>(queue, "test.bin", 1, 8);
+    Task read_task("File reader", std::move(file_reader));
+    boost::asio::thread_pool pool(1);
+    boost::asio::post(pool, std::move(read_task));
+    std::vector<FileBlock> blocks;
+    std::string result;
+    while (queue->pop_bulk(blocks, 3)) {
+        BOOST_CHECK_LE(blocks.size(), 3);
+        for (const FileBlock& block : blocks) {
+            BOOST_CHECK_EQUAL(result.size(), block.position);
+            result.push_back(block.data[0]);
+        }
+    }
+    pool.join();
+    std::filesystem::remove("test.bin");
+    BOOST_CHECK_EQUAL("qwert", result);
+    BOOST_CHECK_EQUAL(true, queue->get_closed());
+}
+
+BOOST_AUTO_TEST_CASE(MemorySignerTest, *boost::unit_test::timeout(5))
+{
+    const std::string expected = "76D80224611FC919A5D54F0FF9FBA446" "24113791D2218CB84C9F0462E91596EF";
+    const std::string data = "qwerty";
+    BOOST_CHECK_EQUAL(expected.size(), MemorySigner::get_signature_size(data.size(), 3));
+    MemorySigner signer(2, 1);
+    std::string result(expected.size(), ' ');
+    signer.sign(data.data(), data.size(), 3, result.data(), result.size());
+    BOOST_CHECK_EQUAL(expected, result);
+
+    std::vector<ConstBuffer> buffers = { ConstBuffer(data.data(), 2), ConstBuffer(data.data() + 2, 0), ConstBuffer(data.data() + 2, 4) };
+    result.assign(expected.size(), ' ');
+    signer.sign(buffers, 3, result.data(), result.size());
+    BOOST_CHECK_EQUAL(expected, result);
+
+    // Called from the only thread of the supplied pool, helpers never get to run
+    boost::asio::thread_pool pool(1);
+    MemorySigner pool_signer(pool, 4, 1);
+    std::string large_data(100 * 3, 'x');
+    std::string large_result(MemorySigner::get_signature_size(large_data.size(), 3), ' ');
+    std::string large_expected(large_result.size(), ' ');
+    signer.sign(large_data.data(), large_data.size(), 3, large_expected.data(), large_expected.size());
+    boost::asio::post(pool, [&]() {
+        result.assign(expected.size(), ' ');
+        pool_signer.sign(buffers, 3, result.data(), result.size());
+        pool_signer.sign(large_data.data(), large_data.size(), 3, large_result.data(), large_result.size());
+    });
+    pool.join();
+    BOOST_CHECK_EQUAL(expected, result);
+    BOOST_CHECK_EQUAL(large_expected, large_result);
+    BOOST_CHECK_EQUAL(large_expected.substr(0, 32), large_expected.substr(32, 32));
+
+    std::string short_result(expected.size() - 1, ' ');
+    BOOST_CHECK_THROW(signer.sign(data.data(), data.size(), 3, short_result.data(), short_result.size()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SignatureCacheTest, *boost::unit_test::timeout(5))
+{
+    std::filesystem::remove_all("test_cache");
+    std::ofstream("test.bin", std::ios::binary) << "qwe";
+    std::ofstream("test.txt", std::ios::binary) << "DEADBEEF\n";
+    SignatureCache cache("test_cache", 15);
+    BOOST_REQUIRE_EQUAL(true, cache.get_enabled());
+    std::string key = cache.make_key("test.bin", 2, "MD5");
+    BOOST_CHECK_NE(key, cache.make_key("test.bin", 3, "MD5"));
+    BOOST_CHECK_EQUAL(false, cache.fetch(key, "test_out.txt"));
+    cache.store(key, "test.txt");
+    BOOST_CHECK_EQUAL(true, cache.fetch(key, "test_out.txt"));
+    std::ifstream t("test_out.txt", std::ios::binary);
+    std::string result((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+    t.close();
+    BOOST_CHECK_EQUAL("DEADBEEF\n", result);
+    // Existing output file is neither overwritten nor removed
+    std::ofstream("test_out.txt", std::ios::binary) << "precious";
+    BOOST_CHECK_EQUAL(false, cache.fetch(key, "test_out.txt"));
+    BOOST_REQUIRE_EQUAL(true, std::filesystem::exists("test_out.txt"));
+    std::ifstream existing("test_out.txt", std::ios::binary);
+    std::string existing_content((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+    existing.close();
+    BOOST_CHECK_EQUAL("precious", existing_content);
+    std::filesystem::remove("test_out.txt");
+
+    // Least recently used entry is evicted once cache exceeds its size limit
+    std::string other_key = cache.make_key("test.bin", 3, "MD5");
+    std::filesystem::last_write_time("test_cache/" + key + ".sig", std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+    cache.store(other_key, "test.txt");
+    BOOST_CHECK_EQUAL(false, cache.fetch(key, "test_out.txt"));
+    BOOST_CHECK_EQUAL(true, cache.fetch(other_key, "test_out.txt"));
+
+    std::filesystem::remove("test_out.txt");
+
+    // Temp files left by killed processes are removed once stale, fresh ones are kept
+    std::ofstream("test_cache/" + key + ".sig.tmp1", std::ios::binary) << "stale";
+    std::ofstream("test_cache/" + key + ".sig.tmp2", std::ios::binary) << "fresh";
+    std::filesystem::last_write_time("test_cache/" + key + ".sig.tmp1", std::filesystem::file_time_type::clock::now() - std::chrono::hours(2));
+    cache.store(key, "test.txt");
+    BOOST_CHECK_EQUAL(false, std::filesystem::exists("test_cache/" + key + ".sig.tmp1"));
+    BOOST_CHECK_EQUAL(true, std::filesystem::exists("test_cache/" + key + ".sig.tmp2"));
+
+    std::filesystem::remove("test.txt");
+    std::filesystem::remove("test.bin");
+    std::filesystem::remove_all("test_cache");
+}
+
+BOOST_AUTO_TEST_CASE(FileBlockHasherMD5MultiResolutionTest, *boost::unit_test::timeout(5))
+{
+    std::shared_ptr<BlockingQueue<FileBlock>> input_queue = std::make_shared<BlockingQueue<FileBlock>>(2);
+    std::vector<std::shared_ptr<BlockingQueue<BlockHash>>> output_queues = {
+        std::make_shared<BlockingQueue<BlockHash>>(4),
+        std::make_shared<BlockingQueue<BlockHash>>(4)
+    };
+    input_queue->start_writing();
+    FileBlock block1(0, 6);
+    std::string block1_data = "qwerty";
+    std::copy(block1_data.begin(), block1_data.end(), block1.data.get());
+    input_queue->push(std::move(block1));
+    FileBlock block2(1, 6);
+    std::string block2_data = "qw";
+    std::copy(block2_data.begin(), block2_data.end(), block2.data.get());
+    std::fill_n(block2.data.get() + 2, 4, 0);
+    block2.data_size = 2;
+    input_queue->push(std::move(block2));
+    input_queue->stop_writing();
+    std::unique_ptr<Worker> hasher = std::make_unique<FileBlockHasherMD5>(input_queue, output_queues, std::vector<size_t>{ 3, 6 });
+    Task hash_task("Hasher", std::move(hasher));
+    hash_task();
+    // Blocks of 3 bytes: "qwe", "rty", "qw\0"; 4th sub-block lies past the end of data and is skipped
+    BOOST_CHECK_EQUAL(3, output_queues[0]->get_size());
+    BOOST_CHECK_EQUAL(2, output_queues[1]->get_size());
+    BlockHash hash;
+    BOOST_CHECK_EQUAL(true, output_queues[0]->pop(hash));
+    BOOST_CHECK_EQUAL(0, hash.position);
+    BOOST_CHECK_EQUAL("76D80224611FC919A5D54F0FF9FBA446", hash.hash_hex);
+    BOOST_CHECK_EQUAL(true, output_queues[0]->pop(hash));
+    BOOST_CHECK_EQUAL(1, hash.position);
+    BOOST_CHECK_EQUAL("24113791D2218CB84C9F0462E91596EF", hash.hash_hex);
+    BOOST_CHECK_EQUAL(true, output_queues[0]->pop(hash));
+    BOOST_CHECK_EQUAL(2, hash.position);
+    BOOST_CHECK_EQUAL("CF74652FE375BC46546187CC273563D5", hash.hash_hex);
+    // Blocks of 6 bytes: "qwerty", "qw\0\0\0\0"
+    BOOST_CHECK_EQUAL(true, output_queues[1]->pop(hash));
+    BOOST_CHECK_EQUAL(0, hash.position);
+    BOOST_CHECK_EQUAL("D8578EDF8458CE06FBC5BB76A58C5CA4", hash.hash_hex);
+    BOOST_CHECK_EQUAL(true, output_queues[1]->pop(hash));
+    BOOST_CHECK_EQUAL(1, hash.position);
+    BOOST_CHECK_EQUAL("8039ACC5917F6D2FBD373B789067A527", hash.hash_hex);
+    BOOST_CHECK_EQUAL(true, output_queues[0]->get_closed());
+    BOOST_CHECK_EQUAL(true, output_queues[1]->get_closed());
+}
+
+BOOST_AUTO_TEST_CASE(ResourceGovernorTest, *boost::unit_test::timeout(5))
+{
+    // 4 Mb/s limit: reading 1 Mb in 256 Kb chunks takes about 0.25 s
+    ResourceGovernor read_governor(4 * 1024 * 1024, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < 4; i++) {
+        read_governor.acquire_read(256 * 1024);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    BOOST_CHECK_GE(elapsed.count(), 0.2);
+
+    // Limits are reloaded from control file
+    std::ofstream("test_control.txt") << "read_limit_mb=0\nmax_hashers=1\n";
+    ResourceGovernor governor(1, 4, "test_control.txt");
+    std::filesystem::remove("test_control.txt");
+    BOOST_CHECK_EQUAL(0, governor.get_read_limit());
+    BOOST_CHECK_EQUAL(1, governor.get_max_active_hashers());
+    start = std::chrono::steady_clock::now();
+    governor.acquire_read(1024 * 1024 * 1024);
+    elapsed = std::chrono::steady_clock::now() - start;
+    BOOST_CHECK_LT(elapsed.count(), 0.1);
+
+    // Only one hasher works at a time
+    std::atomic<size_t> active_hashers = 0;
+    std::atomic<size_t> max_active_hashers = 0;
+    boost::asio::thread_pool pool(4);
+    for (size_t i = 0; i < 4; i++) {
+        boost::asio::post(pool, [&]() {
+            HasherSlot slot(&governor);
+            size_t active = ++active_hashers;
+            max_active_hashers = std::max<size_t>(max_active_hashers, active);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            active_hashers--;
+        });
+    }
+    pool.join();
+    BOOST_CHECK_EQUAL(1, max_active_hashers);
+}
+
+class FailingWorker : public Worker
+{
+public:
+    void on_start() override {}
+    bool do_work() override { throw std::runtime_error("Failure"); }
+    void on_stop() override {}
+};
+
+BOOST_AUTO_TEST_CASE(TaskFailureTest, *boost::unit_test::timeout(5))
+{
+    auto failed = std::make_shared<std::atomic<bool>>(false);
+    Task failing_task("Failing task", std::make_unique<FailingWorker>(), failed);
+    failing_task();
+    BOOST_CHECK_EQUAL(true, *failed);
+}
+
+BOOST_AUTO_TEST_CASE(FileBlockHashWriterZeroGroupingTest, *boost::unit_test::timeout(5))
+{
+    std::shared_ptr<BlockingQueue<BlockHash>> input_queue = std::make_shared<BlockingQueue<BlockHash>>(2);
+    std::filesystem::remove("test.txt");
+    BOOST_CHECK_THROW(FileBlockHashWriter(input_queue, "test.txt", 0), std::runtime_error);
+    std::filesystem::remove("test.txt");
+}